@@ -11,6 +11,7 @@ void ShowHelp(struct array_list **dummy);
 void Quit(struct array_list **dummy);
 
 void Create(struct array_list **a);
+void CreateSmall(struct array_list **a);
 void Destroy(struct array_list **a);
 void ShowStatus(struct array_list **a);
 
@@ -23,14 +24,30 @@ void GetElem(struct array_list **a);
 void SetElem(struct array_list **a);
 
 void FindElem(struct array_list **a);
+void BinarySearch(struct array_list **a);
 void ReplaceElem(struct array_list **a);
+void ToggleIndex(struct array_list **a);
 
 void SortAscending(struct array_list **a);
+void TopK(struct array_list **a);
+void NthElement(struct array_list **a);
+void PartialSort(struct array_list **a);
+void Unique(struct array_list **a);
+void Combine(struct array_list **a);
+void Compress(struct array_list **a);
+void ShowSummary(struct array_list **a);
+void Transform(struct array_list **a);
+void Filter(struct array_list **a);
+void Reduce(struct array_list **a);
 void Traverse(struct array_list **a);
 void TraverseBackward(struct array_list **a);
 
 void VisInt(const void *x);
 int CmpInt(const void *a, const void *b);
+size_t HashInt(const void *x);
+void MulAddInt(void *x, void *ctx);
+bool ModIsInt(const void *x, void *ctx);
+void AddSquareInt(void *acc, const void *x, void *ctx);
 
 int main(void) {
     ArrayList list_int_ = NULL;
@@ -54,6 +71,7 @@ void AddCommands(void (*commands[])(struct array_list **a)) {
     commands['Q'] = Quit;
 
     commands['N'] = Create;
+    commands['O'] = CreateSmall;
     commands['D'] = Destroy;
     commands['L'] = ShowStatus;
 
@@ -66,9 +84,21 @@ void AddCommands(void (*commands[])(struct array_list **a)) {
     commands['M'] = SetElem;
 
     commands['S'] = FindElem;
+    commands['Y'] = BinarySearch;
     commands['P'] = ReplaceElem;
+    commands['X'] = ToggleIndex;
 
     commands['A'] = SortAscending;
+    commands['K'] = TopK;
+    commands['E'] = NthElement;
+    commands['W'] = PartialSort;
+    commands['U'] = Unique;
+    commands['J'] = Combine;
+    commands['Z'] = Compress;
+    commands['V'] = ShowSummary;
+    commands['*'] = Transform;
+    commands['%'] = Filter;
+    commands['+'] = Reduce;
     commands['T'] = Traverse;
     commands['B'] = TraverseBackward;
 }
@@ -77,9 +107,10 @@ void ShowHelp(struct array_list **dummy) {
     puts("静态线性表 (ArrayList) 测试程序。请输入命令，不区分大小写：\n");
     puts("H - 显示帮助 (Help)，");
     puts("Q - 退出程序 (Quit)，\n");
-    puts("N [size] - 新建 (New) 长度为size的表，");
-    puts("D        - 释放表所占空间 (Destroy)，");
-    puts("L        - 显示表长 (Length) 以及其他信息，\n");
+    puts("N [size]    - 新建 (New) 长度为size的表，");
+    puts("O [size][n] - 新建长度为size、前n个元素内联存放的小表 (small)，");
+    puts("D           - 释放表所占空间 (Destroy)，");
+    puts("L           - 显示表长 (Length) 以及其他信息，\n");
     puts("C       - 清空表 (Clear)，");
     puts("F [val] - 以val的值填充 (Fill)，\n");
     puts("I [pos][val] - 在位置pos插入值为val的元素 (Insert)，");
@@ -87,8 +118,21 @@ void ShowHelp(struct array_list **dummy) {
     puts("G [pos]      - 按位置取元素 (Get)，");
     puts("M [pos][val] - 修改元素 (Modify)，\n");
     puts("S [val]         - 按值查找首次出现的元素 (Search)，");
-    puts("P [val][newval] - 按值查找所有与之相等元素并替换 (rePlace)，\n");
+    puts("Y [val]         - 在有序表中二分查找首次出现的元素 (binarY search)，");
+    puts("K [k]           - 显示最小的k个元素 (top-K)，");
+    puts("E [n]           - 把第n小的元素放到位置n并显示 (nth Element)，");
+    puts("W [k]           - 部分排序，使前k个位置为升序的最小k个元素 (loWest k)，");
+    puts("P [val][newval] - 按值查找所有与之相等元素并替换 (rePlace)，");
+    puts("X               - 建立或删除哈希索引，建立后S按索引查找 (indeX)，\n");
+    puts("J [op][n][val]... - 与输入的n个升序元素组成的表做运算并显示结果 (Join)，");
+    puts("                    op为M归并、U并集、I交集或D差集，\n");
     puts("A - 升序排序 (sort Ascending)，");
+    puts("U - 有序表去重 (Unique)，");
+    puts("Z - 压缩或解压有序表 (Zip)，");
+    puts("V - 显示元素的和、最小值与最大值 (Values)，\n");
+    puts("* [mul][add] - 把每个元素x变为x*mul+add (transform)，");
+    puts("% [m][r]     - 显示模m余r的元素 (filter)，");
+    puts("+            - 显示元素的平方和 (reduce)，\n");
     puts("T - 正序遍历 (Traverse)，");
     puts("B - 逆序遍历 (traverse Backward)。");
 }
@@ -120,6 +164,15 @@ void Create(struct array_list **a) {
         puts("创建成功。");
 }
 
+void CreateSmall(struct array_list **a) {
+    size_t initSize, inlineSize;
+    scanf("%lu%lu", &initSize, &inlineSize);
+    ArrayListDelete(a);
+    *a = ArrayListCreateSmall(initSize, sizeof(int), inlineSize);
+    if(*a != NULL)
+        puts("创建成功。");
+}
+
 void Destroy(struct array_list **a) {
     ArrayListDelete(a);
     puts("已释放表。");
@@ -201,16 +254,43 @@ void FindElem(struct array_list **a) {
     }
 }
 
+void BinarySearch(struct array_list **a) {
+    int x;
+    scanf("%d", &x);
+    size_t idx = ArrayListBinarySearch(*a, &x, CmpInt);
+    switch (idx) {
+    case ERROR_SIZE:
+        puts("List not exist!");
+        break;
+    case NOT_FOUND:
+        puts("Not found!");
+        break;
+    default:
+        printf("index of %d is %lu.\n", x, idx);
+        break;
+    }
+}
+
 void ReplaceElem(struct array_list **a) {
-    int val, newval, tmp;
+    int val, newval;
     scanf("%d%d", &val, &newval);
-    ArrayListIter it;
-    for (it = ArrayListIterFirst(*a); ArrayListIterHasNext(it); ArrayListIterNext(it)) {
-        ArrayListIterGetNext(it, &tmp);
-        if (0 == CmpInt(&val, &tmp))
-            ArrayListIterSetNext(it, &newval);
+    size_t count = ArrayListReplaceAll(*a, &val, &newval, CmpInt);
+    if (ERROR_SIZE == count) {
+        puts("替换失败。");
+    } else {
+        printf("已替换 %lu 个元素。\n", count);
+    }
+}
+
+void ToggleIndex(struct array_list **a) {
+    if (ArrayListHasIndex(*a)) {
+        ArrayListIndexDelete(*a);
+        puts("已删除索引。");
+    } else if (ArrayListIndexCreate(*a, HashInt, CmpInt)) {
+        puts("已建立索引。");
+    } else {
+        puts("建立索引失败。");
     }
-    ArrayListIterDelete(&it);
 }
 
 void SortAscending(struct array_list **a) {
@@ -221,6 +301,147 @@ void SortAscending(struct array_list **a) {
     }
 }
 
+void TopK(struct array_list **a) {
+    size_t k, i, length = ArrayListGetLength(*a);
+    scanf("%lu", &k);
+    if (ERROR_SIZE == length || k > length) {
+        puts("查询失败：无效的表或k大于表长。");
+        return;
+    } else if (0 == k) {
+        puts("[]");
+        return;
+    }
+    int *buf = (int *)malloc(k * sizeof(int));
+    if (NULL != buf && ArrayListTopK(*a, k, CmpInt, buf)) {
+        putchar('[');
+        for (i = 0; i < k; i++)
+            VisInt(buf + i);
+        puts("]");
+    } else {
+        puts("查询失败。");
+    }
+    free(buf);
+}
+
+void NthElement(struct array_list **a) {
+    size_t n;
+    int x;
+    scanf("%lu", &n);
+    if (ArrayListNthElement(*a, n, CmpInt) && ArrayListGetElem(*a, n, &x)) {
+        printf("The element at position %lu is %d.\n", n, x);
+    } else {
+        puts("选择失败：无效的表或n超出表长。");
+    }
+}
+
+void PartialSort(struct array_list **a) {
+    size_t k;
+    scanf("%lu", &k);
+    if (ArrayListPartialSort(*a, k, CmpInt)) {
+        puts("已部分排序。");
+    } else {
+        puts("部分排序失败：无效的表或k大于表长。");
+    }
+}
+
+void Unique(struct array_list **a) {
+    if (ArrayListUnique(*a, CmpInt)) {
+        puts("已去重。");
+    } else {
+        puts("去重失败：无效的表。");
+    }
+}
+
+void Combine(struct array_list **a) {
+    char op;
+    size_t n, i;
+    int x;
+    scanf(" %c%lu", &op, &n);
+    struct array_list *b = ArrayListCreate(n > 0 ? n : 1, sizeof(int)), *c = NULL;
+    for (i = 0; i < n; i++) {
+        scanf("%d", &x);
+        ArrayListInsertElem(b, i, &x);
+    }
+    switch (toupper(op)) {
+    case 'M':
+        c = ArrayListMerge(*a, b, CmpInt);
+        break;
+    case 'U':
+        c = ArrayListSetUnion(*a, b, CmpInt);
+        break;
+    case 'I':
+        c = ArrayListSetIntersection(*a, b, CmpInt);
+        break;
+    case 'D':
+        c = ArrayListSetDifference(*a, b, CmpInt);
+        break;
+    default:
+        puts("未知的运算。");
+        ArrayListDelete(&b);
+        return;
+    }
+    if (NULL != c) {
+        Traverse(&c);
+    } else {
+        puts("运算失败：无效的表。");
+    }
+    ArrayListDelete(&b);
+    ArrayListDelete(&c);
+}
+
+void Compress(struct array_list **a) {
+    if (ArrayListIsCompressed(*a)) {
+        puts(ArrayListDecompress(*a) ? "已解压。" : "解压失败。");
+    } else {
+        puts(ArrayListCompress(*a) ? "已压缩。" : "压缩失败：表无效或未排序。");
+    }
+}
+
+void ShowSummary(struct array_list **a) {
+    int64_t sum, min, max;
+    if (ArrayListSumInt(*a, &sum) && ArrayListMinInt(*a, &min) && ArrayListMaxInt(*a, &max)) {
+        printf("sum = %lld, min = %lld, max = %lld\n", (long long)sum, (long long)min, (long long)max);
+    } else {
+        puts("查询失败：无效的表或表为空。");
+    }
+}
+
+void Transform(struct array_list **a) {
+    int ctx[2];
+    scanf("%d%d", &ctx[0], &ctx[1]);
+    if (ArrayListTransform(*a, MulAddInt, ctx)) {
+        puts("已变换。");
+    } else {
+        puts("变换失败：无效的表或表已压缩。");
+    }
+}
+
+void Filter(struct array_list **a) {
+    int ctx[2];
+    scanf("%d%d", &ctx[0], &ctx[1]);
+    size_t length = ArrayListGetLength(*a);
+    if (ERROR_SIZE == length || 0 == ctx[0]) {
+        puts("筛选失败：无效的表或m为0。");
+        return;
+    }
+    struct array_list *out = ArrayListCreate(length > 0 ? length : 1, sizeof(int));
+    if (NULL != out && ArrayListFilter(*a, ModIsInt, ctx, out)) {
+        Traverse(&out);
+    } else {
+        puts("筛选失败。");
+    }
+    ArrayListDelete(&out);
+}
+
+void Reduce(struct array_list **a) {
+    long long acc = 0;
+    if (ArrayListReduce(*a, AddSquareInt, &acc, NULL)) {
+        printf("sum of squares = %lld\n", acc);
+    } else {
+        puts("查询失败：无效的表。");
+    }
+}
+
 void Traverse(struct array_list **a) {
     putchar('[');
     int tmp;
@@ -259,3 +480,19 @@ int CmpInt(const void *a, const void *b) {
         return 0;
     }
 }
+
+size_t HashInt(const void *x) {
+    return (size_t)*(int *)x;
+}
+
+void MulAddInt(void *x, void *ctx) {
+    *(int *)x = *(int *)x * ((int *)ctx)[0] + ((int *)ctx)[1];
+}
+
+bool ModIsInt(const void *x, void *ctx) {
+    return *(int *)x % ((int *)ctx)[0] == ((int *)ctx)[1];
+}
+
+void AddSquareInt(void *acc, const void *x, void *ctx) {
+    *(long long *)acc += (long long)*(int *)x * *(int *)x;
+}
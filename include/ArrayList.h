@@ -21,6 +21,12 @@ extern "C" {
 #define ARRAY_LIST_DEFAULT_CAPACITY (1 << 10)
 #define ARRAY_LIST_DEFAULT_ELEM_SIZE sizeof(int)
 
+// ArrayListCreate() 创建的表中内联存放的元素个数，可在编译时指定
+// Num of elements ArrayListCreate() stores inline, can be set at compile time.
+#ifndef ARRAY_LIST_INLINE_CAPACITY
+#define ARRAY_LIST_INLINE_CAPACITY 0
+#endif
+
 typedef struct array_list* ArrayList;
 typedef struct array_list_iter* ArrayListIter;
 
@@ -28,6 +34,13 @@ typedef struct array_list_iter* ArrayListIter;
 // Initializes a new ArrayList.
 struct array_list* ArrayListCreate(size_t capacity, size_t elem_size);
 
+// 初始化一个新表，前 inline_capacity 个元素存放在表头的同一块内存中
+// Initializes a new ArrayList whose first inline_capacity elements live in the
+// same allocation as the list itself. Heap memory is only allocated once the
+// list grows beyond that.
+struct array_list* ArrayListCreateSmall(size_t capacity, size_t elem_size,
+                                        size_t inline_capacity);
+
 // 释放表的空间并置为空指针
 // Frees memory of list a and set a to NULL.
 void ArrayListDelete(struct array_list **a);
@@ -66,8 +79,9 @@ bool ArrayListClear(struct array_list *a);
 // Fills list a with x's value.
 bool ArrayListFill(struct array_list *a, const void *x);
 
-// 按值查找位置（顺序查找）
+// 按值查找位置（顺序查找，或在比较函数与哈希索引一致时使用索引）
 // Finds an a's element which equals x with comp() and then returns its position.
+// If a has a hash index created with the same comp(), the index is used instead.
 size_t ArrayListFind(const struct array_list *a, const void *x,
                      int (*comp)(const void *, const void *));
 
@@ -76,6 +90,133 @@ size_t ArrayListFind(const struct array_list *a, const void *x,
 bool ArrayListSort(const struct array_list *a,
                    int (*comp)(const void *, const void *));
 
+// 选择第n小的元素（内省选择，期望 O(n)）
+// Rearranges list a so that the element at position n is the one that would be
+// there if a were sorted with comp(); elements before it are not greater and
+// elements after it are not less. Runs in expected O(n) time.
+bool ArrayListNthElement(const struct array_list *a, size_t n,
+                         int (*comp)(const void *, const void *));
+
+// 部分排序（堆排序，O(n log k)）
+// Rearranges list a so that its first k positions hold the k smallest
+// elements in ascending order with comp(); the rest are left in unspecified order.
+bool ArrayListPartialSort(const struct array_list *a, size_t k,
+                          int (*comp)(const void *, const void *));
+
+// 取前k小的元素（不修改表）
+// Copies the k smallest elements of a with comp() into buffer x in ascending
+// order, without modifying a. x must hold at least k * elem_size bytes.
+// Pass a reversed comp() to get the k largest elements.
+bool ArrayListTopK(const struct array_list *a, size_t k,
+                   int (*comp)(const void *, const void *), void *x);
+
+// 有序表去重（保留每组相等元素中的第一个）
+// Removes consecutive elements that equal with comp() from sorted list a,
+// keeping the first one of each group. Runs in O(n).
+bool ArrayListUnique(struct array_list *a,
+                     int (*comp)(const void *, const void *));
+
+// 归并两个有序表，返回新表
+// Merges sorted lists a and b into a new sorted list (stable, a first on ties).
+// Returns NULL on failure. The new list's capacity is a->length + b->length,
+// or 1 if both lists are empty.
+struct array_list* ArrayListMerge(const struct array_list *a,
+                                  const struct array_list *b,
+                                  int (*comp)(const void *, const void *));
+
+// 有序表的并集，返回新表
+// Returns a new sorted list holding the union of sorted lists a and b.
+// Like all the set operations below, it counts the result first, so the new
+// list's capacity equals its length (or 1 if the result is empty).
+struct array_list* ArrayListSetUnion(const struct array_list *a,
+                                     const struct array_list *b,
+                                     int (*comp)(const void *, const void *));
+
+// 有序表的交集，返回新表
+// Returns a new sorted list holding the intersection of sorted lists a and b.
+struct array_list* ArrayListSetIntersection(const struct array_list *a,
+                                            const struct array_list *b,
+                                            int (*comp)(const void *, const void *));
+
+// 有序表的差集 a - b，返回新表
+// Returns a new sorted list holding elements of sorted list a that are not in b.
+struct array_list* ArrayListSetDifference(const struct array_list *a,
+                                          const struct array_list *b,
+                                          int (*comp)(const void *, const void *));
+
+// 以哈希函数和比较函数建立哈希索引
+// Creates a hash index mapping element values to positions, using hash() and comp().
+// Equal elements must have equal hashes. The index is kept up to date by all
+// functions that modify a, and ArrayListFind() uses it when given the same comp().
+bool ArrayListIndexCreate(struct array_list *a, size_t (*hash)(const void *),
+                          int (*comp)(const void *, const void *));
+
+// 以元素中的键字节建立哈希索引
+// Creates a hash index on the key_len bytes at key_offset of each element.
+// Elements are equal if their key bytes are equal. Use ArrayListIndexFind() to look up.
+bool ArrayListIndexCreateByKey(struct array_list *a, size_t key_offset, size_t key_len);
+
+// 删除哈希索引
+// Deletes the hash index of list a if it has one.
+void ArrayListIndexDelete(struct array_list *a);
+
+bool ArrayListHasIndex(const struct array_list *a);
+
+// 按值查找位置（哈希索引，期望 O(1)）
+// Finds the first element of a which equals x by the hash index and returns its position.
+size_t ArrayListIndexFind(const struct array_list *a, const void *x);
+
+// 压缩有序整数表（块内差分 + 按位压缩，压缩后只读）
+// Compresses list a of ascending int32_t or int64_t elements (elem_size 4 or 8)
+// into blocks of bit-packed deltas with a per-block skip index.
+// A compressed list is read-only: GetElem, Find, BinarySearch and the iterator
+// getters work on it, functions that modify it fail until it is decompressed.
+// Reads don't write to the list, so several threads may read it at once.
+// Lists with a hash index can't be compressed.
+bool ArrayListCompress(struct array_list *a);
+
+// 解压为普通存储
+// Converts compressed list a back to plain storage.
+bool ArrayListDecompress(struct array_list *a);
+
+bool ArrayListIsCompressed(const struct array_list *a);
+
+// 按值查找位置（二分查找）
+// Finds the first element of sorted list a which equals x with comp() by
+// binary search and returns its position. Compressed lists search the block index first.
+size_t ArrayListBinarySearch(const struct array_list *a, const void *x,
+                             int (*comp)(const void *, const void *));
+
+// 对每个元素原地调用 fn
+// Calls fn(elem, ctx) on every element of a in place, in one pass over the storage.
+bool ArrayListTransform(struct array_list *a, void (*fn)(void *, void *), void *ctx);
+
+// 把满足 pred 的元素追加到表 out 的末尾
+// Appends copies of the elements of a for which pred(elem, ctx) is true to the
+// tail of list out. Fails when out becomes full.
+bool ArrayListFilter(const struct array_list *a, bool (*pred)(const void *, void *),
+                     void *ctx, struct array_list *out);
+
+// 依次以每个元素调用 fn 累积到 acc 中
+// Calls fn(acc, elem, ctx) on every element of a in order. acc holds the
+// initial value on entry and the result on return.
+bool ArrayListReduce(const struct array_list *a, void (*fn)(void *, const void *, void *),
+                     void *acc, void *ctx);
+
+// 把所有与 x 相等的元素替换为 y，返回替换的个数
+// Replaces every element of a which equals x with comp() by y and
+// returns the num of replaced elements.
+size_t ArrayListReplaceAll(struct array_list *a, const void *x, const void *y,
+                           int (*comp)(const void *, const void *));
+
+// 整数表（elem_size 为 4 或 8 的有符号整数）的求和、最小值和最大值
+// Sum, minimum and maximum of a list of int32_t or int64_t elements.
+bool ArrayListSumInt(const struct array_list *a, int64_t *x);
+
+bool ArrayListMinInt(const struct array_list *a, int64_t *x);
+
+bool ArrayListMaxInt(const struct array_list *a, int64_t *x);
+
 // 新初始化一个指定位置的ArrayList迭代器
 // Creates a new iterator points to current_pos of list a.
 struct array_list_iter* ArrayListIterCreate(const struct array_list *a,
@@ -15,6 +15,11 @@
 #define ERR_MSG_NULL_POINTER       "null pointer"
 #define ERR_MSG_INDEX_OUT_OF_RANGE "index out of range"
 #define ERR_MSG_OUT_OF_MEMORY      "out of memory"
+#define ERR_MSG_ELEM_SIZE_MISMATCH "element size mismatch"
+#define ERR_MSG_NO_INDEX           "list has no index"
+#define ERR_MSG_COMPRESSED         "list is compressed"
+#define ERR_MSG_NOT_COMPRESSIBLE   "list is not a sorted integer list"
+#define ERR_MSG_HAS_INDEX          "list has an index"
 
 #define PRINT_ERR_MSG(MSG_STR)                                                                      \
 do {                                                                                                \
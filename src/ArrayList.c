@@ -15,24 +15,421 @@ struct array_list {
     size_t elem_size;   // 元素大小     size of single element
     size_t capacity;    // 最大容量     max capacity
     size_t length;      // 当前元素个数 current num of elements
-};
+    struct array_list_index *index; // 哈希索引，未启用时为空 optional hash index, NULL if disabled
+    size_t inline_capacity;         // 内联元素个数           num of elements stored inline
+    size_t inline_free_count;       // 空闲内联块个数         num of free inline blocks
+    void **inline_data;             // 内联的指针数组         inline pointer array
+    void **inline_free;             // 空闲内联块栈           stack of free inline blocks
+    char *inline_pool;              // 内联元素块             inline element blocks
+    struct array_list_packed *packed;   // 压缩存储，未压缩时为空 compressed storage, NULL if not compressed
+    size_t generation;                  // 压缩次数，用于判断迭代器的块缓存是否过期
+};                                      // num of compressions, tells iterators their block cache is stale
 
 struct array_list_iter {
-    void **ptr_to_elem;             // 指向当前元素   pointer to current element
+    size_t pos;                     // 当前位置       current position
     struct array_list *ptr_to_list; // 记录所对应的表 pointer to the array list
+    struct array_list_pack_cache *cache;    // 压缩表的块解码缓存，为本迭代器独有
+};                                          // block cache for compressed lists, owned by this iterator
+
+#define ARRAY_LIST_INLINE_ALIGN 16  // 内联元素块的最大对齐  max alignment of inline element blocks
+#define ROUND_UP(N, ALIGN) (((N) + (ALIGN) - 1) / (ALIGN) * (ALIGN))
+
+// 分配一个元素块，优先使用内联块
+// Allocates an element block, taking a free inline block first.
+static void* ElemAlloc(struct array_list *a) {
+    if (a->inline_free_count > 0)
+        return a->inline_free[--a->inline_free_count];
+    void *p = malloc(a->elem_size);
+    if (NULL == p)
+        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+    return p;
+}
+
+// 释放一个元素块，内联块归还到空闲栈
+// Frees an element block, returning inline blocks to the free stack.
+static void ElemFree(struct array_list *a, void *p) {
+    uintptr_t u = (uintptr_t)p, pool = (uintptr_t)a->inline_pool;
+    if (u >= pool && u < pool + a->inline_capacity * a->elem_size)
+        a->inline_free[a->inline_free_count++] = p;
+    else
+        free(p);
+}
+
+// 保证指针数组能容纳 n 个元素，超出内联容量时把指针数组移到堆上
+// Ensures the pointer array can hold n elements,
+// moving it from the inline storage to the heap once the list outgrows it.
+static bool DataReserve(struct array_list *a, size_t n) {
+    if (a->data != a->inline_data || n <= a->inline_capacity)
+        return true;
+    void **data = (void **)malloc(a->capacity * sizeof(void *));
+    if (NULL == data) {
+        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+        return false;
+    }
+    memcpy(data, a->data, a->length * sizeof(void *));
+    a->data = data;
+    return true;
+}
+
+struct array_list_index_slot {
+    size_t home;    // 元素哈希值对应的槽位         slot the value's hash maps to
+    size_t count;   // 该值出现的次数，0 为空槽     num of positions holding the value, 0 if empty
+    size_t cap;     // many 的容量，0 时位置存于 one  capacity of many, 0 if the position is in one
+    union {
+        size_t one;     // 唯一的位置             the only position
+        size_t *many;   // 升序排列的位置         positions in ascending order
+    } pos;
 };
 
+struct array_list_index {
+    size_t (*hash)(const void *);                   // 哈希函数，为空时按键字节哈希
+    int (*comp)(const void *, const void *);        // hash function, NULL to hash key bytes
+    size_t key_offset;                              // 键在元素中的偏移   offset of key in element
+    size_t key_len;                                 // 键的字节数         length of key in bytes
+    unsigned shift;                                 // 64 - log2(槽位数)  64 - log2(num of slots)
+    bool broken;                                    // 内存不足时失效，查找退化为顺序查找
+                                                    // out of memory, lookups fall back to a linear scan
+    size_t num_slots;                               // 槽位数，2 的幂     num of slots, a power of 2
+    struct array_list_index_slot *slots;            // 开放定址（线性探测），每个不同的值占一个槽位
+};                                                  // open addressing (linear probing), one slot per distinct value
+
+// 计算元素 x 在索引中的起始槽位
+// Returns the home slot of x in the index (Fibonacci hashing on top of the element hash).
+static size_t IndexHome(const struct array_list_index *idx, const void *x) {
+    uint64_t h;
+    if (NULL != idx->hash) {
+        h = idx->hash(x);
+    } else {                            // FNV-1a 哈希键的字节
+        const unsigned char *p = (const unsigned char *)x + idx->key_offset;
+        const unsigned char *p_end = p + idx->key_len;  // FNV-1a over the key bytes
+        for (h = 14695981039346656037ULL; p < p_end; p++)
+            h = (h ^ *p) * 1099511628211ULL;
+    }
+    return (size_t)((h * 11400714819323198485ULL) >> idx->shift);
+}
+
+// 判断元素 x 与 y 是否相等
+// Checks if x equals y under the index's comp() or key bytes.
+static bool IndexEqual(const struct array_list_index *idx, const void *x, const void *y) {
+    if (NULL != idx->hash)
+        return 0 == idx->comp(x, y);
+    return 0 == memcmp((const char *)x + idx->key_offset,
+                       (const char *)y + idx->key_offset, idx->key_len);
+}
+
+// 槽位中升序排列的位置
+// Returns the ascending positions stored in slot s.
+static size_t* SlotPositions(struct array_list_index_slot *s) {
+    return 0 == s->cap ? &s->pos.one : s->pos.many;
+}
+
+// 在槽位中二分查找不小于 pos 的第一个位置的下标
+// Returns the index of the first position in slot s not less than pos.
+static size_t SlotLowerBound(struct array_list_index_slot *s, size_t pos) {
+    const size_t *p = SlotPositions(s);
+    size_t lo = 0, hi = s->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (p[mid] < pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// 把位置 pos 按序加入槽位 s
+// Inserts pos into the ascending positions of slot s.
+static bool SlotInsert(struct array_list_index_slot *s, size_t pos) {
+    if (0 == s->count) {
+        s->cap = 0;
+        s->pos.one = pos;
+        s->count = 1;
+        return true;
+    } else if (s->count == s->cap || 0 == s->cap) {
+        size_t cap = 0 == s->cap ? 4 : 2 * s->cap;
+        size_t *many = (size_t *)realloc(0 == s->cap ? NULL : s->pos.many, cap * sizeof(size_t));
+        if (NULL == many)
+            return false;
+        if (0 == s->cap)
+            many[0] = s->pos.one;
+        s->pos.many = many;
+        s->cap = cap;
+    }
+    size_t i = s->pos.many[s->count - 1] < pos ? s->count : SlotLowerBound(s, pos);
+    memmove(s->pos.many + i + 1, s->pos.many + i, (s->count - i) * sizeof(size_t));
+    s->pos.many[i] = pos;
+    s->count++;
+    return true;
+}
+
+// 找到起始槽位为 home 且含有位置 pos 的槽位（只比较位置，不调用 comp）
+// Finds the slot with the given home that holds position pos. Only positions
+// are compared, so it works while moved elements are being fixed up.
+static struct array_list_index_slot* IndexSlotOf(const struct array_list_index *idx,
+                                                 size_t home, size_t pos, size_t *k) {
+    size_t i;
+    for (i = home; ; i = (i + 1) & (idx->num_slots - 1)) {
+        struct array_list_index_slot *s = idx->slots + i;
+        if (s->home != home)            // 起始槽位不同的值不必查找
+            continue;                   // skip values with another home slot
+        *k = SlotLowerBound(s, pos);
+        if (*k < s->count && SlotPositions(s)[*k] == pos)
+            return s;
+    }
+}
+
+// 索引失效：释放各槽位的位置表，之后的查找退化为顺序查找
+// Marks the index broken after running out of memory; lookups fall back to a linear scan.
+static void IndexBreak(struct array_list_index *idx) {
+    size_t i;
+    for (i = 0; i < idx->num_slots; i++) {
+        if (0 != idx->slots[i].cap)
+            free(idx->slots[i].pos.many);
+        idx->slots[i].count = idx->slots[i].cap = 0;
+    }
+    idx->broken = true;
+    PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+}
+
+// 把位置 pos 上的元素加入索引
+// Adds the element at position pos of list a to its index.
+static void IndexAdd(const struct array_list *a, size_t pos) {
+    struct array_list_index *idx = a->index;
+    if (idx->broken)
+        return;
+    size_t home = IndexHome(idx, a->data[pos]), i = home;
+    for (; 0 != idx->slots[i].count; i = (i + 1) & (idx->num_slots - 1)) {
+        struct array_list_index_slot *s = idx->slots + i;
+        if (s->home == home && IndexEqual(idx, a->data[pos], a->data[SlotPositions(s)[0]]))
+            break;                      // 已有相等的值，加入其位置表
+    }                                   // the value is already indexed, add to its positions
+    idx->slots[i].home = home;
+    if (!SlotInsert(idx->slots + i, pos))
+        IndexBreak(idx);
+}
+
+// 把位置 pos 上的元素移出索引，值不再出现时后移删除槽位（不留墓碑）
+// Removes the element at position pos of list a from its index. When its value
+// no longer occurs, the slot is removed by backward shifting, leaving no tombstones.
+static void IndexErase(const struct array_list *a, size_t pos) {
+    struct array_list_index *idx = a->index;
+    if (idx->broken)
+        return;
+    size_t mask = idx->num_slots - 1, k, i, j;
+    struct array_list_index_slot *s = IndexSlotOf(idx, IndexHome(idx, a->data[pos]), pos, &k);
+    size_t *p = SlotPositions(s);
+    memmove(p + k, p + k + 1, (s->count - k - 1) * sizeof(size_t));
+    if (--s->count > 0)
+        return;
+    if (0 != s->cap)
+        free(s->pos.many);
+    s->cap = 0;
+    for (i = s - idx->slots, j = (i + 1) & mask; 0 != idx->slots[j].count; j = (j + 1) & mask) {
+        size_t h = idx->slots[j].home;  // 起始槽位在 (i, j] 内的槽位不能前移
+        if (i <= j ? (i < h && h <= j) : (i < h || h <= j))
+            continue;                   // slots whose home lies in (i, j] must stay
+        idx->slots[i] = idx->slots[j];
+        i = j;
+    }
+    idx->slots[i].count = idx->slots[i].cap = 0;
+}
+
+// 元素被 memmove 从位置 from 移到 to 后，修正其索引项
+// Updates the index entry of the element memmove'd from position from to position to.
+// Only that value's slot is visited, so fixing up all moved elements costs
+// the same order as the memmove itself, however many duplicates there are.
+static void IndexMove(const struct array_list *a, size_t from, size_t to) {
+    struct array_list_index *idx = a->index;
+    if (idx->broken)
+        return;
+    size_t k;
+    struct array_list_index_slot *s = IndexSlotOf(idx, IndexHome(idx, a->data[to]), from, &k);
+    SlotPositions(s)[k] = to;
+}
+
+// 清空索引后按当前元素重建
+// Rebuilds the index of list a from scratch.
+static void IndexRebuild(const struct array_list *a) {
+    struct array_list_index *idx = a->index;
+    size_t i;
+    for (i = 0; i < idx->num_slots; i++) {
+        if (0 != idx->slots[i].cap)
+            free(idx->slots[i].pos.many);
+        idx->slots[i].count = idx->slots[i].cap = 0;
+    }
+    idx->broken = false;                // 按位置递增加入，每次都追加到位置表末尾
+    for (i = 0; i < a->length; i++)     // positions are added in ascending order, so each one is appended
+        IndexAdd(a, i);
+}
+
+// 在索引中查找与 x 相等的第一个元素
+// Returns the smallest position whose element equals x, or NOT_FOUND.
+static size_t IndexFind(const struct array_list *a, const void *x) {
+    const struct array_list_index *idx = a->index;
+    size_t i;
+    if (idx->broken) {
+        for (i = 0; i < a->length; i++) {
+            if (IndexEqual(idx, x, a->data[i]))
+                return i;
+        }
+        return NOT_FOUND;
+    }
+    size_t home = IndexHome(idx, x);
+    for (i = home; 0 != idx->slots[i].count; i = (i + 1) & (idx->num_slots - 1)) {
+        struct array_list_index_slot *s = idx->slots + i;
+        if (s->home == home && IndexEqual(idx, x, a->data[SlotPositions(s)[0]]))
+            return SlotPositions(s)[0];
+    }
+    return NOT_FOUND;
+}
+
+#define PACK_BLOCK_LEN 128      // 每块的元素个数  num of elements per compressed block
+
+struct array_list_pack_block {
+    int64_t first;  // 块内第一个值           first value in the block
+    size_t offset;  // 差值在 words 中的偏移  offset of the packed deltas in words
+    unsigned width; // 每个差值的位数         bits per delta
+};
+
+struct array_list_packed {
+    size_t num_blocks;                      // 块数                 num of blocks
+    struct array_list_pack_block *blocks;   // 块索引               skip index of blocks
+    uint64_t *words;                        // 按位压缩的差值       bit-packed deltas
+};
+
+struct array_list_pack_cache {
+    size_t generation;                      // 解码时表的压缩次数   generation of the list when decoded
+    size_t block;                           // 已解码的块，无则为 SIZE_MAX  decoded block, SIZE_MAX if none
+    int64_t values[PACK_BLOCK_LEN];         // 解码结果             decoded values
+};
+
+// 从元素中读出有符号整数
+// Loads a signed integer of elem_size bytes from element p.
+static int64_t LoadInt(const void *p, size_t elem_size) {
+    if (sizeof(int32_t) == elem_size) {
+        int32_t v;
+        memcpy(&v, p, sizeof v);
+        return v;
+    }
+    int64_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+// 把有符号整数写入元素
+// Stores v into element p of elem_size bytes.
+static void StoreInt(void *p, size_t elem_size, int64_t v) {
+    if (sizeof(int32_t) == elem_size) {
+        int32_t v32 = (int32_t)v;
+        memcpy(p, &v32, sizeof v32);
+    } else {
+        memcpy(p, &v, sizeof v);
+    }
+}
+
+// 解码第 b 块的前 len 个值：先无分支地定长解包差值，再求前缀和。
+// 解包循环在支持 gather 的指令集（如 AVX2）上可被自动向量化；前缀和有循环依赖，按顺序执行
+// Decodes the first len values of block b into out: a branch-free fixed-width
+// unpack of the deltas, then a prefix sum. The unpack loop auto-vectorizes on
+// targets with gathers (e.g. -mavx2); the prefix sum carries a dependency
+// from one value to the next and runs sequentially.
+static void PackDecodeBlock(const struct array_list_packed *pk, size_t b, size_t len,
+                            int64_t *out) {
+    const struct array_list_pack_block *blk = pk->blocks + b;
+    const uint64_t *src = pk->words + blk->offset;
+    uint64_t delta[PACK_BLOCK_LEN];
+    unsigned w = blk->width;
+    uint64_t mask = w >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << w) - 1;
+    size_t i;
+    for (i = 0; i + 1 < len; i++) {     // 跨字的差值由相邻两个字拼出（末尾有填充字）
+        size_t bit = i * w;             // deltas crossing a word boundary are joined from two words
+        unsigned sh = bit & 63;         // (words has a padding word at its end)
+        delta[i] = ((src[bit >> 6] >> sh) | ((src[(bit >> 6) + 1] << 1) << (63 - sh))) & mask;
+    }
+    uint64_t acc = (uint64_t)blk->first;
+    out[0] = blk->first;
+    for (i = 1; i < len; i++) {
+        acc += delta[i-1];
+        out[i] = (int64_t)acc;
+    }
+}
+
+// 把第 b 块解码到调用者的缓冲区 buf 中。读操作不修改表，多个线程可以同时读取压缩表
+// Decodes block b of list a into the caller's buffer buf. Reads never write to
+// the list, so a compressed list can be read from several threads at once.
+static const int64_t* PackBlock(const struct array_list *a, size_t b, int64_t *buf) {
+    size_t len = a->length - b * PACK_BLOCK_LEN;
+    PackDecodeBlock(a->packed, b, len < PACK_BLOCK_LEN ? len : PACK_BLOCK_LEN, buf);
+    return buf;
+}
+
+// 顺序读取压缩表的第 i 个元素，i 为块首时先把新块解码到 block
+// Reads element i of compressed list a into x during a sequential scan,
+// decoding the next block into block whenever i starts one.
+static const void* PackNext(const struct array_list *a, size_t i, int64_t *block, int64_t *x) {
+    if (0 == i % PACK_BLOCK_LEN)
+        PackBlock(a, i / PACK_BLOCK_LEN, block);
+    StoreInt(x, a->elem_size, block[i % PACK_BLOCK_LEN]);
+    return x;
+}
+
+// 读出位置 pos 上的元素，兼容压缩存储（只解码到 pos 为止）
+// Copies the element at position pos to x, for both plain and compressed storage.
+// For compressed lists only the block prefix up to pos is decoded.
+static void LoadElem(const struct array_list *a, size_t pos, void *x) {
+    if (NULL == a->packed) {
+        memcpy(x, a->data[pos], a->elem_size);
+    } else {
+        int64_t block[PACK_BLOCK_LEN];
+        PackDecodeBlock(a->packed, pos / PACK_BLOCK_LEN, pos % PACK_BLOCK_LEN + 1, block);
+        StoreInt(x, a->elem_size, block[pos % PACK_BLOCK_LEN]);
+    }
+}
+
 // 初始化一个新表
 struct array_list* ArrayListCreate(size_t capacity, size_t elem_size) {
-    struct array_list *a = (struct array_list *)malloc(sizeof(struct array_list));
+    return ArrayListCreateSmall(capacity, elem_size, ARRAY_LIST_INLINE_CAPACITY);
+}
+
+// 初始化一个新表，前 inline_capacity 个元素存放在表头的同一块内存中
+struct array_list* ArrayListCreateSmall(size_t capacity, size_t elem_size,
+                                        size_t inline_capacity) {
+    elem_size = elem_size > 0 ? elem_size : ARRAY_LIST_DEFAULT_ELEM_SIZE;   // 避免容量和 elem_size 为 0 的情况
+    capacity = capacity > 0 ? capacity : ARRAY_LIST_DEFAULT_CAPACITY;       // capacity or elem_size == zero is not allowed
+    if (inline_capacity > capacity)
+        inline_capacity = capacity;
+    size_t align = elem_size & (~elem_size + 1);    // 内联元素块紧密排列，按整除 elem_size 的最大 2 的幂对齐（不超过 16）
+    if (align > ARRAY_LIST_INLINE_ALIGN)            // inline element blocks are packed back to back, aligned to the
+        align = ARRAY_LIST_INLINE_ALIGN;            // largest power of 2 dividing elem_size, capped at 16
+    size_t pool_offset = ROUND_UP(sizeof(struct array_list)                 // 表头之后依次是内联指针数组、空闲块栈和内联元素块
+                                  + 2 * inline_capacity * sizeof(void *),   // the header is followed by the inline pointer array,
+                                  align);                                   // the free block stack and the inline element blocks
+    struct array_list *a = (struct array_list *)
+                           malloc(pool_offset + inline_capacity * elem_size);
     if (NULL == a)          // 空间分配失败
         goto ALLOC_FAILED;  // memory alloc failed
-    a->data = (void **)malloc(capacity * sizeof(void *));
-    if (NULL == a->data)    // 空间分配失败
-        goto ALLOC_FAILED;  // memory alloc failed
-    a->elem_size = elem_size > 0 ? elem_size : ARRAY_LIST_DEFAULT_ELEM_SIZE;// 避免容量和 elem_size 为 0 的情况
-    a->capacity = capacity > 0 ? capacity : ARRAY_LIST_DEFAULT_CAPACITY;    // capacity or elem_size == zero is not allowed
+    if (inline_capacity > 0) {
+        a->data = a->inline_data = (void **)(a + 1);
+    } else {
+        a->inline_data = NULL;
+        a->data = (void **)malloc(capacity * sizeof(void *));
+        if (NULL == a->data)    // 空间分配失败
+            goto ALLOC_FAILED;  // memory alloc failed
+    }
+    a->elem_size = elem_size;
+    a->capacity = capacity;
     a->length = 0;
+    a->index = NULL;
+    a->packed = NULL;
+    a->generation = 0;
+    a->inline_capacity = inline_capacity;
+    a->inline_free_count = inline_capacity;
+    a->inline_free = (void **)(a + 1) + inline_capacity;
+    a->inline_pool = (char *)a + pool_offset;
+    size_t i;                   // 栈顶为第一个块
+    for (i = 0; i < inline_capacity; i++)   // the first block is on the top of the stack
+        a->inline_free[i] = a->inline_pool + (inline_capacity - 1 - i) * elem_size;
     return a;
 
     ALLOC_FAILED:   // 防止内存泄漏
@@ -45,9 +442,17 @@ struct array_list* ArrayListCreate(size_t capacity, size_t elem_size) {
 void ArrayListDelete(struct array_list **a) {   // 为了在 free() 后把 a 置为NULL，传参为二级指针，即对指针 a 取地址
     if (NULL != *a) {                           // to set pointer a = NULL after free(), parameter is **a
         void **p, **p_end = (*a)->data + (*a)->length;
+        if (NULL != (*a)->packed) {
+            free((*a)->packed->blocks);
+            free((*a)->packed->words);
+            free((*a)->packed);
+            p_end = (*a)->data;
+        }
         for (p = (*a)->data; p < p_end; p++)
-            free(*p);
-        free((*a)->data);
+            ElemFree(*a, *p);
+        if ((*a)->data != (*a)->inline_data)
+            free((*a)->data);
+        ArrayListIndexDelete(*a);
     }
     free(*a);
     *a = NULL;
@@ -98,19 +503,26 @@ bool ArrayListInsertElem(struct array_list *a, size_t pos, const void *x) {
     if (NULL == a || NULL == x) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     } else if (pos > a->length || ArrayListIsFull(a)) { // 表满或位置错误时，不能插入
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);      // can't insert when array is full or position is wrong
         return false;                                   // 可插入的位置：0~length，共 (length+1)个
     }                                                   // from 0 to length, there are (length+1) positions can insert
-    void *tmp = malloc(a->elem_size);
-    if (NULL == tmp) {
-        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
-        return false;
-    }                               // 把后半部分元素向后移一个位置
+    void *tmp;
+    if (!DataReserve(a, a->length + 1) || NULL == (tmp = ElemAlloc(a)))
+        return false;               // 把后半部分元素向后移一个位置
     memcpy(tmp, x, a->elem_size);   // move the latter half part of array backward one position
     memmove(a->data + pos + 1, a->data + pos, (a->length - pos) * sizeof(void *));
     a->data[pos] = tmp;             // 再把 x 写入空出来的位置
-    a->length++;                    // and then write x to the empty position
+    if (NULL != a->index) {         // and then write x to the empty position
+        size_t i;                   // 从后往前修正后移的元素，避免与未修正的位置重复
+        for (i = a->length; i > pos; i--)   // fix up moved elements back to front so an updated
+            IndexMove(a, i - 1, i);         // position never equals one still to be searched for
+        IndexAdd(a, pos);
+    }
+    a->length++;
     return true;
 }
 
@@ -119,13 +531,23 @@ bool ArrayListRemoveElem(struct array_list *a, size_t pos) {
     if (NULL == a) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     } else if (pos >= a->length) {                  // 可删除的位置：0~(length-1)，共 length 个
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);  // from 0 to (length-1), there are length positions can remove
         return false;
     }
-    free(a->data[pos]);
-    memmove(a->data + pos, a->data + pos + 1, (a->length - pos) * sizeof(void *));  // 把后半部分元素向前移一个位置
+    if (NULL != a->index)
+        IndexErase(a, pos);
+    ElemFree(a, a->data[pos]);
+    memmove(a->data + pos, a->data + pos + 1, (a->length - pos - 1) * sizeof(void *));  // 把后半部分元素向前移一个位置
     a->length--;                                        // move the latter half part of array forward one position
+    if (NULL != a->index) {                             // 从前往后修正前移的元素
+        size_t i;                                       // fix up moved elements front to back
+        for (i = pos; i < a->length; i++)
+            IndexMove(a, i + 1, i);
+    }
     return true;
 }
 
@@ -138,7 +560,7 @@ bool ArrayListGetElem(const struct array_list *a, size_t pos, void *x) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
-    memcpy(x, a->data[pos], a->elem_size);
+    LoadElem(a, pos, x);
     return true;
 }
 
@@ -147,11 +569,18 @@ bool ArrayListSetElem(const struct array_list *a, size_t pos, const void *x) {
     if (NULL == a || NULL == x) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     } else if (pos >= a->length) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
+    if (NULL != a->index)
+        IndexErase(a, pos);
     memcpy(a->data[pos], x, a->elem_size);
+    if (NULL != a->index)
+        IndexAdd(a, pos);
     return true;
 }
 
@@ -160,11 +589,16 @@ bool ArrayListClear(struct array_list *a) {
     if (NULL == a) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     }
     void **p, **p_end = a->data + a->length;
     for (p = a->data; p < p_end; p++)
-        free(*p);
+        ElemFree(a, *p);
     a->length = 0;
+    if (NULL != a->index)
+        IndexRebuild(a);
     return true;
 }
 
@@ -173,19 +607,27 @@ bool ArrayListFill(struct array_list *a, const void *x) {
     if (NULL == a || NULL == x) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     }
+    if (!DataReserve(a, a->capacity))
+        return false;
     void **p, **p_end = a->data + a->length;// 从0到length-1，修改元素的值
     for (p = a->data; p < p_end; p++)       // from 0 to (length-1)，change the value of elements
         memcpy(*p, x, a->elem_size);
     for (p_end = a->data + a->capacity; p < p_end; p++) {
-        *p = malloc(a->elem_size);          // 从length到capacity-1，新分配空间插入元素
+        *p = ElemAlloc(a);                  // 从length到capacity-1，新分配空间插入元素
         if (NULL == *p) {                   // from length to (capacity-1), alloc new space and insert elements
-            PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+            if (NULL != a->index)
+                IndexRebuild(a);
             return false;
         }
         memcpy(*p, x, a->elem_size);
         a->length++;
     }
+    if (NULL != a->index)
+        IndexRebuild(a);
     return true;
 }
 
@@ -195,6 +637,16 @@ size_t ArrayListFind(const struct array_list *a, const void *x,
     if (NULL == a || NULL == x || NULL == comp) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return ERROR_SIZE;
+    } else if (NULL != a->index && comp == a->index->comp) {
+        return IndexFind(a, x);         // 比较函数与索引一致时使用哈希索引
+    } else if (NULL != a->packed) {     // use the hash index when comp() matches it
+        int64_t block[PACK_BLOCK_LEN], buf;
+        size_t i;
+        for (i = 0; i < a->length; i++) {
+            if (0 == comp(x, PackNext(a, i, block, &buf)))
+                return i;
+        }
+        return NOT_FOUND;
     }
     void **p, **p_end = a->data + a->length;
     for (p = a->data; p < p_end; p++) {
@@ -210,6 +662,9 @@ bool ArrayListSort(const struct array_list *a,
     if (NULL == a || NULL == comp) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     }
     size_t i, j;
     void *tmp;
@@ -222,9 +677,829 @@ bool ArrayListSort(const struct array_list *a,
             }
         }
     }
+    if (NULL != a->index)               // 元素位置改变后重建索引
+        IndexRebuild(a);                // rebuild the index since positions have changed
+    return true;
+}
+
+#define ARRAY_LIST_SELECT_THRESHOLD 16  // 区间长度小于此值时改用插入排序
+                                        // use insertion sort for ranges shorter than this
+
+// 交换两个元素指针
+static void SwapPtr(void **x, void **y) {
+    void *tmp = *x;
+    *x = *y;
+    *y = tmp;
+}
+
+// 对 base[0..n-1] 插入排序（升序）
+static void InsertionSortPtr(void **base, size_t n,
+                             int (*comp)(const void *, const void *)) {
+    size_t i, j;
+    for (i = 1; i < n; i++) {
+        void *tmp = base[i];
+        for (j = i; j > 0 && comp(base[j-1], tmp) > 0; j--)
+            base[j] = base[j-1];
+        base[j] = tmp;
+    }
+}
+
+// 大顶堆下沉：heap[0..n-1] 中以 i 为根的子树
+// Sifts heap[i] down in the max-heap heap[0..n-1].
+static void HeapSiftDown(void **heap, size_t i, size_t n,
+                         int (*comp)(const void *, const void *)) {
+    void *tmp = heap[i];
+    size_t child;
+    while ((child = 2 * i + 1) < n) {
+        if (child + 1 < n && comp(heap[child], heap[child+1]) < 0)
+            child++;                    // 取较大的孩子
+        if (comp(tmp, heap[child]) >= 0)// pick the larger child
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = tmp;
+}
+
+// 把 base[0..n-1] 中最小的 k 个元素按升序放到前 k 个位置
+// Moves the k smallest of base[0..n-1] to base[0..k-1] in ascending order.
+static void HeapPartialSort(void **base, size_t n, size_t k,
+                            int (*comp)(const void *, const void *)) {
+    size_t i;
+    if (0 == k)
+        return;
+    for (i = k / 2; i > 0; i--)         // 前 k 个元素建大顶堆
+        HeapSiftDown(base, i - 1, k, comp); // build a max-heap on the first k elements
+    for (i = k; i < n; i++) {           // 比堆顶小的元素替换堆顶
+        if (comp(base[i], base[0]) < 0) {   // replace the top with any smaller element
+            SwapPtr(base, base + i);
+            HeapSiftDown(base, 0, k, comp);
+        }
+    }
+    for (i = k - 1; i > 0; i--) {       // 堆排序得到升序
+        SwapPtr(base, base + i);        // heapsort the k elements into ascending order
+        HeapSiftDown(base, 0, i, comp);
+    }
+}
+
+// Hoare 划分（三数取中），返回 j 使得 [l, j] 不大于 [j+1, r]
+// Hoare partition with median-of-three on base[l..r];
+// returns j so that base[l..j] <= base[j+1..r].
+static size_t HoarePartition(void **base, size_t l, size_t r,
+                             int (*comp)(const void *, const void *)) {
+    size_t m = l + (r - l) / 2;
+    if (comp(base[m], base[l]) < 0)
+        SwapPtr(base + m, base + l);
+    if (comp(base[r], base[m]) < 0) {
+        SwapPtr(base + r, base + m);
+        if (comp(base[m], base[l]) < 0)
+            SwapPtr(base + m, base + l);
+    }
+    void *pivot = base[m];
+    size_t i = l, j = r;
+    for (; ; ) {
+        while (comp(base[i], pivot) < 0)
+            i++;
+        while (comp(pivot, base[j]) < 0)
+            j--;
+        if (i >= j)
+            return j;
+        SwapPtr(base + i, base + j);
+        i++;
+        j--;
+    }
+}
+
+// 内省选择：快速选择，递归过深时退化为堆选择以保证 O(n log n) 上界
+// Introselect: quickselect that falls back to heap selection
+// when partitioning goes too deep, bounding the worst case to O(n log n).
+static void IntroSelect(void **base, size_t n, size_t nth,
+                        int (*comp)(const void *, const void *)) {
+    size_t l = 0, r = n - 1, depth = 0;
+    for (; n > 1; n >>= 1)
+        depth += 2;
+    while (r - l + 1 > ARRAY_LIST_SELECT_THRESHOLD) {
+        if (0 == depth--) {
+            HeapPartialSort(base + l, r - l + 1, nth - l + 1, comp);
+            return;
+        }
+        size_t p = HoarePartition(base, l, r, comp);
+        if (nth <= p)
+            r = p;
+        else
+            l = p + 1;
+    }
+    InsertionSortPtr(base + l, r - l + 1, comp);
+}
+
+// 选择第n小的元素（内省选择，期望 O(n)）
+bool ArrayListNthElement(const struct array_list *a, size_t n,
+                         int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    } else if (n >= a->length) {
+        PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
+        return false;
+    }
+    IntroSelect(a->data, a->length, n, comp);
+    if (NULL != a->index)
+        IndexRebuild(a);
+    return true;
+}
+
+// 部分排序（堆排序，O(n log k)）
+bool ArrayListPartialSort(const struct array_list *a, size_t k,
+                          int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    } else if (k > a->length) {
+        PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
+        return false;
+    }
+    HeapPartialSort(a->data, a->length, k, comp);
+    if (NULL != a->index)
+        IndexRebuild(a);
+    return true;
+}
+
+// 取前k小的元素（不修改表）
+bool ArrayListTopK(const struct array_list *a, size_t k,
+                   int (*comp)(const void *, const void *), void *x) {
+    if (NULL == a || NULL == comp || NULL == x) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    } else if (k > a->length) {
+        PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
+        return false;
+    } else if (0 == k) {
+        return true;
+    }
+    void **heap = (void **)malloc(k * sizeof(void *));
+    if (NULL == heap) {
+        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+        return false;
+    }
+    size_t i;                           // 在指针副本上维护大小为 k 的大顶堆，表本身不变
+    void **p, **p_end = a->data + a->length;// keep a max-heap of k pointers, leaving a untouched
+    memcpy(heap, a->data, k * sizeof(void *));
+    for (i = k / 2; i > 0; i--)
+        HeapSiftDown(heap, i - 1, k, comp);
+    for (p = a->data + k; p < p_end; p++) {
+        if (comp(*p, heap[0]) < 0) {
+            heap[0] = *p;
+            HeapSiftDown(heap, 0, k, comp);
+        }
+    }
+    for (i = k - 1; i > 0; i--) {
+        SwapPtr(heap, heap + i);
+        HeapSiftDown(heap, 0, i, comp);
+    }
+    for (i = 0; i < k; i++)
+        memcpy((char *)x + i * a->elem_size, heap[i], a->elem_size);
+    free(heap);
+    return true;
+}
+
+// 有序表去重（保留每组相等元素中的第一个）
+bool ArrayListUnique(struct array_list *a,
+                     int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    } else if (a->length < 2) {
+        return true;
+    }
+    void **w = a->data, **p, **p_end = a->data + a->length;
+    for (p = a->data + 1; p < p_end; p++) {
+        if (0 != comp(*w, *p))  // 与上一个保留的元素不同则保留，否则释放
+            *++w = *p;          // keep it if differs from the last kept one, otherwise free it
+        else
+            ElemFree(a, *p);
+    }
+    a->length = w - a->data + 1;
+    if (NULL != a->index)
+        IndexRebuild(a);
+    return true;
+}
+
+// 检查有序表运算的两个操作数
+// Checks that a and b are plain lists with the same element size.
+static bool OperandsValid(const struct array_list *a, const struct array_list *b) {
+    if (a->elem_size != b->elem_size) {
+        PRINT_ERR_MSG(ERR_MSG_ELEM_SIZE_MISMATCH);
+        return false;
+    } else if (NULL != a->packed || NULL != b->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    }
+    return true;
+}
+
+// 在表尾追加 x 的副本（调用者保证表未满）
+// Appends a copy of x to the tail of list a. The caller ensures a is not full.
+static bool AppendCopy(struct array_list *a, const void *x) {
+    void *tmp;
+    if (!DataReserve(a, a->length + 1) || NULL == (tmp = ElemAlloc(a)))
+        return false;
+    memcpy(tmp, x, a->elem_size);
+    a->data[a->length++] = tmp;
+    return true;
+}
+
+// 归并两个有序表，返回新表
+struct array_list* ArrayListMerge(const struct array_list *a,
+                                  const struct array_list *b,
+                                  int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == b || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return NULL;
+    }
+    if (!OperandsValid(a, b))
+        return NULL;
+    size_t n = a->length + b->length;       // 容量为 0 表示默认容量，故至少为 1
+    struct array_list *c = ArrayListCreate(n > 0 ? n : 1, a->elem_size);
+    if (NULL == c)                          // a zero capacity means the default one, so use at least 1
+        return NULL;
+    void **pa = a->data, **pa_end = a->data + a->length;
+    void **pb = b->data, **pb_end = b->data + b->length;
+    while (pa < pa_end || pb < pb_end) {
+        void *x = (pa == pa_end || (pb < pb_end && comp(*pb, *pa) < 0)) ? *pb++ : *pa++;
+        if (!AppendCopy(c, x)) {
+            ArrayListDelete(&c);
+            return NULL;
+        }
+    }
+    return c;
+}
+
+#define SET_OP_ONLY_A 1     // 输出只在 a 中的元素  emit elements only in a
+#define SET_OP_ONLY_B 2     // 输出只在 b 中的元素  emit elements only in b
+#define SET_OP_BOTH   4     // 输出两表共有的元素   emit elements in both a and b
+
+// 对两个有序表做一趟集合运算，ops 决定输出哪些元素。c 为空时只计数
+// Walks sorted lists a and b once, appending elements selected by ops to c,
+// or only counting them if c is NULL. Returns the count, or ERROR_SIZE on failure.
+static size_t SetWalk(const struct array_list *a, const struct array_list *b,
+                      int (*comp)(const void *, const void *),
+                      int ops, struct array_list *c) {
+    size_t count = 0;
+    void **pa = a->data, **pa_end = a->data + a->length;
+    void **pb = b->data, **pb_end = b->data + b->length;
+    while (pa < pa_end || pb < pb_end) {
+        if ((pa == pa_end && !(ops & SET_OP_ONLY_B))    // 剩余部分不会再输出时提前结束
+         || (pb == pb_end && !(ops & SET_OP_ONLY_A)))   // stop early when the rest can't be emitted
+            break;
+        void *x;
+        int which, r = pa == pa_end ? 1 : pb == pb_end ? -1 : comp(*pa, *pb);
+        if (r < 0) {            // 只在 a 中
+            x = *pa++;          // only in a
+            which = SET_OP_ONLY_A;
+        } else if (r > 0) {     // 只在 b 中
+            x = *pb++;          // only in b
+            which = SET_OP_ONLY_B;
+        } else {                // 两表共有
+            x = *pa++;          // in both
+            pb++;
+            which = SET_OP_BOTH;
+        }
+        if (ops & which) {
+            if (NULL != c && !AppendCopy(c, x))
+                return ERROR_SIZE;
+            count++;
+        }
+    }
+    return count;
+}
+
+// 先计数再输出，使结果表的容量恰为其长度
+// Counts the result first so the new list's capacity is exactly its length.
+static struct array_list* SetOperation(const struct array_list *a,
+                                       const struct array_list *b,
+                                       int (*comp)(const void *, const void *),
+                                       int ops) {
+    if (!OperandsValid(a, b))
+        return NULL;
+    size_t n = SetWalk(a, b, comp, ops, NULL);
+    struct array_list *c = ArrayListCreate(n > 0 ? n : 1, a->elem_size);
+    if (NULL != c && ERROR_SIZE == SetWalk(a, b, comp, ops, c))
+        ArrayListDelete(&c);
+    return c;
+}
+
+// 有序表的并集，返回新表
+struct array_list* ArrayListSetUnion(const struct array_list *a,
+                                     const struct array_list *b,
+                                     int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == b || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return NULL;
+    }
+    return SetOperation(a, b, comp, SET_OP_ONLY_A | SET_OP_ONLY_B | SET_OP_BOTH);
+}
+
+// 有序表的交集，返回新表
+struct array_list* ArrayListSetIntersection(const struct array_list *a,
+                                            const struct array_list *b,
+                                            int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == b || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return NULL;
+    }
+    return SetOperation(a, b, comp, SET_OP_BOTH);
+}
+
+// 有序表的差集 a - b，返回新表
+struct array_list* ArrayListSetDifference(const struct array_list *a,
+                                          const struct array_list *b,
+                                          int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == b || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return NULL;
+    }
+    return SetOperation(a, b, comp, SET_OP_ONLY_A);
+}
+
+// 新建哈希索引并为当前元素建立索引项
+// Allocates an index for list a, replacing any existing one, and fills it.
+static bool IndexCreate(struct array_list *a, size_t (*hash)(const void *),
+                        int (*comp)(const void *, const void *),
+                        size_t key_offset, size_t key_len) {
+    struct array_list_index *idx = (struct array_list_index *)
+                                   malloc(sizeof(struct array_list_index));
+    if (NULL == idx) {
+        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+        return false;
+    }
+    idx->shift = 64;                    // 槽位数取不小于容量两倍的 2 的幂，装载因子不超过 0.5
+    idx->num_slots = 1;                 // num of slots is a power of 2 no less than twice the capacity,
+    while (idx->num_slots < 2 * a->capacity) {  // so the load factor never exceeds 0.5
+        idx->num_slots <<= 1;
+        idx->shift--;
+    }
+    idx->slots = (struct array_list_index_slot *)
+                 calloc(idx->num_slots, sizeof(struct array_list_index_slot));
+    if (NULL == idx->slots) {
+        free(idx);
+        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+        return false;
+    }
+    idx->hash = hash;
+    idx->comp = comp;
+    idx->key_offset = key_offset;
+    idx->key_len = key_len;
+    ArrayListIndexDelete(a);
+    a->index = idx;
+    IndexRebuild(a);
+    if (idx->broken) {
+        ArrayListIndexDelete(a);
+        return false;
+    }
     return true;
 }
 
+// 以哈希函数和比较函数建立哈希索引
+bool ArrayListIndexCreate(struct array_list *a, size_t (*hash)(const void *),
+                          int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == hash || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    }
+    return IndexCreate(a, hash, comp, 0, 0);
+}
+
+// 以元素中的键字节建立哈希索引
+bool ArrayListIndexCreateByKey(struct array_list *a, size_t key_offset, size_t key_len) {
+    if (NULL == a) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    } else if (key_len == 0 || key_len > a->elem_size
+               || key_offset > a->elem_size - key_len) {
+        PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
+        return false;
+    }
+    return IndexCreate(a, NULL, NULL, key_offset, key_len);
+}
+
+// 删除哈希索引
+void ArrayListIndexDelete(struct array_list *a) {
+    if (NULL != a && NULL != a->index) {
+        size_t i;
+        for (i = 0; i < a->index->num_slots; i++) {
+            if (0 != a->index->slots[i].cap)
+                free(a->index->slots[i].pos.many);
+        }
+        free(a->index->slots);
+        free(a->index);
+        a->index = NULL;
+    }
+}
+
+bool ArrayListHasIndex(const struct array_list *a) {
+    if (NULL == a) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    }
+    return NULL != a->index;
+}
+
+// 按值查找位置（哈希索引）
+size_t ArrayListIndexFind(const struct array_list *a, const void *x) {
+    if (NULL == a || NULL == x) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return ERROR_SIZE;
+    } else if (NULL == a->index) {
+        PRINT_ERR_MSG(ERR_MSG_NO_INDEX);
+        return ERROR_SIZE;
+    }
+    return IndexFind(a, x);
+}
+
+// 压缩有序整数表（块内差分 + 按位压缩，压缩后只读）
+bool ArrayListCompress(struct array_list *a) {
+    if (NULL == a) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        return true;
+    } else if (NULL != a->index) {
+        PRINT_ERR_MSG(ERR_MSG_HAS_INDEX);
+        return false;
+    } else if (sizeof(int32_t) != a->elem_size && sizeof(int64_t) != a->elem_size) {
+        PRINT_ERR_MSG(ERR_MSG_NOT_COMPRESSIBLE);
+        return false;
+    }
+    size_t i, b, num_words = 0, num_blocks = (a->length + PACK_BLOCK_LEN - 1) / PACK_BLOCK_LEN;
+    struct array_list_pack_block *blocks = (struct array_list_pack_block *)
+            malloc((num_blocks > 0 ? num_blocks : 1) * sizeof(struct array_list_pack_block));
+    if (NULL == blocks) {
+        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+        return false;
+    }
+    for (b = 0; b < num_blocks; b++) {  // 第一趟：检查有序并计算每块的位宽
+        size_t begin = b * PACK_BLOCK_LEN;  // first pass: check order and compute bit widths
+        size_t end = begin + PACK_BLOCK_LEN < a->length ? begin + PACK_BLOCK_LEN : a->length;
+        int64_t prev = LoadInt(a->data[begin], a->elem_size);
+        uint64_t max_delta = 0;
+        if (b > 0 && prev < LoadInt(a->data[begin - 1], a->elem_size))
+            goto NOT_SORTED;
+        blocks[b].first = prev;
+        for (i = begin + 1; i < end; i++) {
+            int64_t v = LoadInt(a->data[i], a->elem_size);
+            if (v < prev)
+                goto NOT_SORTED;
+            if ((uint64_t)v - (uint64_t)prev > max_delta)
+                max_delta = (uint64_t)v - (uint64_t)prev;
+            prev = v;
+        }
+        for (blocks[b].width = 0; max_delta > 0; max_delta >>= 1)
+            blocks[b].width++;
+        blocks[b].offset = num_words;
+        num_words += ((end - begin - 1) * blocks[b].width + 63) / 64;
+    }
+    struct array_list_packed *pk = (struct array_list_packed *)
+                                   malloc(sizeof(struct array_list_packed));
+    uint64_t *words = (uint64_t *)calloc(num_words + 2, sizeof(uint64_t));
+    if (NULL == pk || NULL == words) {  // 末尾的两个填充字使解码时总能读取下一个字
+        free(pk);                       // two padding words let decoding always read the next word
+        free(words);
+        free(blocks);
+        PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+        return false;
+    }
+    for (b = 0; b < num_blocks; b++) {  // 第二趟：写入差值
+        size_t begin = b * PACK_BLOCK_LEN, bit = 0; // second pass: pack the deltas
+        size_t end = begin + PACK_BLOCK_LEN < a->length ? begin + PACK_BLOCK_LEN : a->length;
+        unsigned w = blocks[b].width;
+        uint64_t *dst = words + blocks[b].offset;
+        int64_t prev = blocks[b].first;
+        for (i = begin + 1; i < end; i++, bit += w) {
+            int64_t v = LoadInt(a->data[i], a->elem_size);
+            uint64_t delta = (uint64_t)v - (uint64_t)prev;
+            unsigned sh = bit & 63;
+            dst[bit >> 6] |= delta << sh;
+            if (sh + w > 64)
+                dst[(bit >> 6) + 1] |= delta >> (64 - sh);
+            prev = v;
+        }
+    }
+    pk->num_blocks = num_blocks;
+    pk->blocks = blocks;
+    pk->words = words;
+    for (i = 0; i < a->length; i++)     // 释放原有的元素和指针数组
+        ElemFree(a, a->data[i]);        // free the elements and the pointer array
+    if (a->data != a->inline_data)
+        free(a->data);
+    a->data = a->inline_data;
+    a->packed = pk;
+    a->generation++;
+    return true;
+
+    NOT_SORTED:
+    free(blocks);
+    PRINT_ERR_MSG(ERR_MSG_NOT_COMPRESSIBLE);
+    return false;
+}
+
+// 解压为普通存储
+bool ArrayListDecompress(struct array_list *a) {
+    if (NULL == a) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL == a->packed) {
+        return true;
+    }
+    size_t i, length = a->length;
+    int64_t block[PACK_BLOCK_LEN], buf;
+    if (NULL == a->data) {
+        a->data = (void **)malloc(a->capacity * sizeof(void *));
+        if (NULL == a->data) {
+            PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+            return false;
+        }
+    } else {
+        a->length = 0;                  // 内联指针数组中尚无元素
+        bool reserved = DataReserve(a, length); // the inline pointer array holds no elements yet
+        a->length = length;
+        if (!reserved)
+            return false;
+    }
+    for (i = 0; i < length; i++) {
+        a->data[i] = ElemAlloc(a);
+        if (NULL == a->data[i]) {       // 失败时保持压缩状态
+            while (i > 0)               // stay compressed on failure
+                ElemFree(a, a->data[--i]);
+            return false;
+        }
+        memcpy(a->data[i], PackNext(a, i, block, &buf), a->elem_size);
+    }
+    free(a->packed->blocks);
+    free(a->packed->words);
+    free(a->packed);
+    a->packed = NULL;
+    return true;
+}
+
+bool ArrayListIsCompressed(const struct array_list *a) {
+    if (NULL == a) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    }
+    return NULL != a->packed;
+}
+
+// 按值查找位置（二分查找）
+size_t ArrayListBinarySearch(const struct array_list *a, const void *x,
+                             int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == x || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return ERROR_SIZE;
+    }
+    size_t lo = 0, hi = a->length;      // 在 [lo, hi) 中找第一个不小于 x 的位置
+    if (NULL == a->packed) {            // find the first position not less than x in [lo, hi)
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (comp(a->data[mid], x) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo < a->length && 0 == comp(a->data[lo], x) ? lo : NOT_FOUND;
+    }
+    int64_t buf;                        // 先在块索引上二分，找到最后一个首元素小于 x 的块
+    size_t b_lo = 0, b_hi = a->packed->num_blocks;  // binary search the skip index first for
+    while (b_lo < b_hi) {                           // the last block whose first value is less than x
+        size_t mid = b_lo + (b_hi - b_lo) / 2;
+        StoreInt(&buf, a->elem_size, a->packed->blocks[mid].first);
+        if (comp(&buf, x) < 0)
+            b_lo = mid + 1;
+        else
+            b_hi = mid;
+    }
+    if (b_lo > 0) {                     // 再在该块内二分
+        lo = (b_lo - 1) * PACK_BLOCK_LEN;   // then binary search inside that block
+        hi = lo + PACK_BLOCK_LEN < a->length ? lo + PACK_BLOCK_LEN : a->length;
+        int64_t block[PACK_BLOCK_LEN];
+        PackBlock(a, b_lo - 1, block);
+        size_t begin = lo;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            StoreInt(&buf, a->elem_size, block[mid - begin]);
+            if (comp(&buf, x) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+    }
+    if (lo >= a->length)
+        return NOT_FOUND;
+    LoadElem(a, lo, &buf);
+    return 0 == comp(&buf, x) ? lo : NOT_FOUND;
+}
+
+// 对每个元素原地调用 fn
+bool ArrayListTransform(struct array_list *a, void (*fn)(void *, void *), void *ctx) {
+    if (NULL == a || NULL == fn) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    }
+    void **p, **p_end = a->data + a->length;
+    for (p = a->data; p < p_end; p++)
+        fn(*p, ctx);
+    if (NULL != a->index)
+        IndexRebuild(a);
+    return true;
+}
+
+// 把满足 pred 的元素追加到表 out 的末尾
+bool ArrayListFilter(const struct array_list *a, bool (*pred)(const void *, void *),
+                     void *ctx, struct array_list *out) {
+    if (NULL == a || NULL == pred || NULL == out) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (NULL != out->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
+    } else if (a->elem_size != out->elem_size) {
+        PRINT_ERR_MSG(ERR_MSG_ELEM_SIZE_MISMATCH);
+        return false;
+    }
+    size_t i, length = a->length;       // 先记下长度，a 与 out 相同时不会遍历新追加的元素
+    int64_t block[PACK_BLOCK_LEN], buf; // read length first so appended elements aren't visited if a == out
+    for (i = 0; i < length; i++) {      // 压缩存储的元素逐块解码
+        const void *x = NULL != a->packed ? PackNext(a, i, block, &buf) : a->data[i];
+        if (!pred(x, ctx))
+            continue;
+        if (out->length >= out->capacity) {
+            PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
+            return false;
+        } else if (!AppendCopy(out, x)) {
+            return false;
+        }
+        if (NULL != out->index)
+            IndexAdd(out, out->length - 1);
+    }
+    return true;
+}
+
+// 依次以每个元素调用 fn 累积到 acc 中
+bool ArrayListReduce(const struct array_list *a, void (*fn)(void *, const void *, void *),
+                     void *acc, void *ctx) {
+    if (NULL == a || NULL == fn || NULL == acc) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    }
+    size_t i;
+    int64_t block[PACK_BLOCK_LEN], buf;
+    if (NULL != a->packed) {
+        for (i = 0; i < a->length; i++)
+            fn(acc, PackNext(a, i, block, &buf), ctx);
+    } else {
+        for (i = 0; i < a->length; i++)
+            fn(acc, a->data[i], ctx);
+    }
+    return true;
+}
+
+// 把所有与 x 相等的元素替换为 y，返回替换的个数
+size_t ArrayListReplaceAll(struct array_list *a, const void *x, const void *y,
+                           int (*comp)(const void *, const void *)) {
+    if (NULL == a || NULL == x || NULL == y || NULL == comp) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return ERROR_SIZE;
+    } else if (NULL != a->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return ERROR_SIZE;
+    }
+    size_t i, count = 0;
+    for (i = 0; i < a->length; i++) {
+        if (0 != comp(x, a->data[i]))
+            continue;
+        if (NULL != a->index)
+            IndexErase(a, i);
+        memcpy(a->data[i], y, a->elem_size);
+        if (NULL != a->index)
+            IndexAdd(a, i);
+        count++;
+    }
+    return count;
+}
+
+// 取出从 begin 开始的 len 个整数（len 不超过一块，begin 按块对齐）
+// Returns len integers of list a starting at block-aligned position begin,
+// decoded from the compressed block or gathered from the element blocks into buf.
+static const int64_t* IntChunk(const struct array_list *a, size_t begin, size_t len,
+                               int64_t *buf) {
+    if (NULL != a->packed)
+        return PackBlock(a, begin / PACK_BLOCK_LEN, buf);
+    size_t i;
+    for (i = 0; i < len; i++)
+        buf[i] = LoadInt(a->data[begin + i], a->elem_size);
+    return buf;
+}
+
+// 检查整数聚合函数的参数
+// Checks the arguments of the integer aggregate kernels.
+static bool IntArgsValid(const struct array_list *a, const int64_t *x) {
+    if (NULL == a || NULL == x) {
+        PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
+        return false;
+    } else if (sizeof(int32_t) != a->elem_size && sizeof(int64_t) != a->elem_size) {
+        PRINT_ERR_MSG(ERR_MSG_ELEM_SIZE_MISMATCH);
+        return false;
+    }
+    return true;
+}
+
+// 整数表求和
+bool ArrayListSumInt(const struct array_list *a, int64_t *x) {
+    if (!IntArgsValid(a, x))
+        return false;
+    int64_t buf[PACK_BLOCK_LEN];
+    uint64_t sum = 0;                   // 无符号累加，溢出时按补码回绕
+    size_t begin, i;                    // accumulate unsigned so overflow wraps around
+    for (begin = 0; begin < a->length; begin += PACK_BLOCK_LEN) {
+        size_t len = a->length - begin < PACK_BLOCK_LEN ? a->length - begin : PACK_BLOCK_LEN;
+        const int64_t *chunk = IntChunk(a, begin, len, buf);
+        for (i = 0; i < len; i++)       // 定长块上的无分支循环，可自动向量化
+            sum += (uint64_t)chunk[i];  // branch-free loop over a chunk, auto-vectorizable
+    }
+    *x = (int64_t)sum;
+    return true;
+}
+
+// 求整数表的最小值或最大值
+// Finds the minimum (or maximum if max is true) of integer list a.
+static bool IntMinMax(const struct array_list *a, bool max, int64_t *x) {
+    if (!IntArgsValid(a, x)) {
+        return false;
+    } else if (0 == a->length) {
+        PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
+        return false;
+    }
+    int64_t buf[PACK_BLOCK_LEN], lo = INT64_MAX, hi = INT64_MIN;
+    size_t begin, i;
+    for (begin = 0; begin < a->length; begin += PACK_BLOCK_LEN) {
+        size_t len = a->length - begin < PACK_BLOCK_LEN ? a->length - begin : PACK_BLOCK_LEN;
+        const int64_t *chunk = IntChunk(a, begin, len, buf);
+        for (i = 0; i < len; i++) {
+            lo = chunk[i] < lo ? chunk[i] : lo;
+            hi = chunk[i] > hi ? chunk[i] : hi;
+        }
+    }
+    *x = max ? hi : lo;
+    return true;
+}
+
+// 整数表的最小值
+bool ArrayListMinInt(const struct array_list *a, int64_t *x) {
+    return IntMinMax(a, false, x);
+}
+
+// 整数表的最大值
+bool ArrayListMaxInt(const struct array_list *a, int64_t *x) {
+    return IntMinMax(a, true, x);
+}
+
+// 迭代器读取位置 pos 上的元素，压缩表使用迭代器自己的块缓存
+// Copies the element at position pos to x, using the iterator's own block cache
+// for compressed lists.
+static void IterLoad(const struct array_list_iter *it, size_t pos, void *x) {
+    const struct array_list *a = it->ptr_to_list;
+    if (NULL == a->packed || NULL == it->cache) {
+        LoadElem(a, pos, x);
+        return;
+    }
+    if (pos / PACK_BLOCK_LEN != it->cache->block || a->generation != it->cache->generation) {
+        PackBlock(a, pos / PACK_BLOCK_LEN, it->cache->values);
+        it->cache->block = pos / PACK_BLOCK_LEN;    // 表在解压修改后重新压缩过，缓存的块已过期
+        it->cache->generation = a->generation;      // the list may have been decompressed, modified
+    }                                               // and compressed again since the block was decoded
+    StoreInt(x, a->elem_size, it->cache->values[pos % PACK_BLOCK_LEN]);
+}
+
 // 新初始化一个指定位置的ArrayList迭代器
 struct array_list_iter* ArrayListIterCreate(const struct array_list *a,
                                             size_t pos) {
@@ -241,13 +1516,26 @@ struct array_list_iter* ArrayListIterCreate(const struct array_list *a,
         PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
         return NULL;
     }
-    it->ptr_to_elem = a->data + pos;
+    it->pos = pos;
     it->ptr_to_list = (struct array_list *)a;
+    it->cache = NULL;
+    if (NULL != a->packed) {            // 压缩表的迭代器自带块缓存，顺序遍历时每块只解码一次
+        it->cache = (struct array_list_pack_cache *)    // iterators of compressed lists have their own
+                    malloc(sizeof(struct array_list_pack_cache));   // block cache so each block is decoded once
+        if (NULL == it->cache) {
+            free(it);
+            PRINT_ERR_MSG(ERR_MSG_OUT_OF_MEMORY);
+            return NULL;
+        }
+        it->cache->block = SIZE_MAX;
+    }
     return it;
 }
 
 // 销毁迭代器并置为空指针
 void ArrayListIterDelete(struct array_list_iter **it) {
+    if (NULL != *it)
+        free((*it)->cache);
     free(*it);
     *it = NULL;
 }
@@ -276,8 +1564,7 @@ bool ArrayListIterHasNext(const struct array_list_iter *it) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
     }
-    return it->ptr_to_elem < it->ptr_to_list->data + it->ptr_to_list->length
-        && it->ptr_to_elem >= it->ptr_to_list->data;
+    return it->pos < it->ptr_to_list->length;
 }
 
 // 令迭代器移动到Next位置
@@ -289,7 +1576,7 @@ bool ArrayListIterNext(struct array_list_iter *it) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
-    it->ptr_to_elem++;
+    it->pos++;
     return true;
 }
 
@@ -302,7 +1589,7 @@ bool ArrayListIterGetNext(const struct array_list_iter *it, void *x) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
-    memcpy(x, *(it->ptr_to_elem), it->ptr_to_list->elem_size);
+    IterLoad(it, it->pos, x);
     return true;
 }
 
@@ -311,11 +1598,20 @@ bool ArrayListIterSetNext(const struct array_list_iter *it, const void *x) {
     if (NULL == x || NULL == it) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != it->ptr_to_list->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     } else if (!ArrayListIterHasNext(it)) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
-    memcpy(*(it->ptr_to_elem), x, it->ptr_to_list->elem_size);
+    const struct array_list *a = it->ptr_to_list;
+    size_t pos = it->pos;
+    if (NULL != a->index)
+        IndexErase(a, pos);
+    memcpy(a->data[pos], x, a->elem_size);
+    if (NULL != a->index)
+        IndexAdd(a, pos);
     return true;
 }
 
@@ -325,8 +1621,7 @@ bool ArrayListIterHasPrev(const struct array_list_iter *it) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
     }
-    return it->ptr_to_elem > it->ptr_to_list->data
-        && it->ptr_to_elem <= it->ptr_to_list->data + it->ptr_to_list->length;
+    return it->pos > 0 && it->pos <= it->ptr_to_list->length;
 }
 
 // 令迭代器移动到Prev位置
@@ -338,7 +1633,7 @@ bool ArrayListIterPrev(struct array_list_iter *it) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
-    it->ptr_to_elem--;
+    it->pos--;
     return true;
 }
 
@@ -351,7 +1646,7 @@ bool ArrayListIterGetPrev(const struct array_list_iter *it, void *x) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
-    memcpy(x, *(it->ptr_to_elem - 1), it->ptr_to_list->elem_size);
+    IterLoad(it, it->pos - 1, x);
     return true;
 }
 
@@ -360,10 +1655,19 @@ bool ArrayListIterSetPrev(const struct array_list_iter *it, const void *x) {
     if (NULL == x || NULL == it) {
         PRINT_ERR_MSG(ERR_MSG_NULL_POINTER);
         return false;
+    } else if (NULL != it->ptr_to_list->packed) {
+        PRINT_ERR_MSG(ERR_MSG_COMPRESSED);
+        return false;
     } else if (!ArrayListIterHasPrev(it)) {
         PRINT_ERR_MSG(ERR_MSG_INDEX_OUT_OF_RANGE);
         return false;
     }
-    memcpy(*(it->ptr_to_elem - 1), x, it->ptr_to_list->elem_size);
+    const struct array_list *a = it->ptr_to_list;
+    size_t pos = it->pos - 1;
+    if (NULL != a->index)
+        IndexErase(a, pos);
+    memcpy(a->data[pos], x, a->elem_size);
+    if (NULL != a->index)
+        IndexAdd(a, pos);
     return true;
 }